@@ -0,0 +1,17 @@
+from setuptools import setup, Extension
+
+# Build the simulator as a Python extension module (without its main program).
+trafficsim = Extension(
+    "trafficsim",
+    sources=[
+        "trafficsim.c",
+        "../src/runSimulations.c",
+        "../src/queue.c",
+        "../src/util.c",
+    ],
+    include_dirs=["../src"],
+    define_macros=[("SIMULATION_LIBRARY", None)],
+    libraries=["gsl", "gslcblas"],
+)
+
+setup(name="trafficsim", version="1.0", ext_modules=[trafficsim])
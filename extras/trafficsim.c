@@ -0,0 +1,407 @@
+/* Compiler directives. */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#ifndef __RUNSIMULATIONS_H
+#define __RUNSIMULATIONS_H
+#include <runSimulations.h>
+#endif
+
+/* Number of columns in a set of results, the same as in result.csv. */
+#define NUMBER_OF_COLUMNS 12
+
+/* Global variables. */
+
+/* Lock for the random number generator, which is shared by all threads. */
+static PyThread_type_lock SIMULATION_LOCK;
+
+/* Structure definitions. */
+
+/* Results object, used for exposing points to Python through the buffer
+ * protocol. Values are stored as doubles in column-major order, so each
+ * column is contiguous and NumPy can use it without copying. */
+typedef struct {
+	PyObject_HEAD
+	double *data;
+	Py_ssize_t shape[2];
+	Py_ssize_t strides[2];
+} RESULTS;
+
+/* Function definitions. */
+
+/* Free a results object. */
+static void results_dealloc(RESULTS *self) {
+	PyMem_RawFree(self->data);
+	Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+/* Get the number of points in a results object. */
+static Py_ssize_t results_length(RESULTS *self) {
+	return self->shape[0];
+}
+
+/* Export a results object as a 2D array of doubles. */
+static int results_getbuffer(RESULTS *self, Py_buffer *view, int flags) {
+	/* Columns are contiguous, rows are not (unless there is only one). */
+	if ((flags & PyBUF_C_CONTIGUOUS) == PyBUF_C_CONTIGUOUS && self->shape[0] > 1) {
+		PyErr_SetString(PyExc_BufferError, "results are stored in column-major order");
+		view->obj = NULL;
+		return -1;
+	}
+	if ((flags & PyBUF_STRIDES) != PyBUF_STRIDES) {
+		PyErr_SetString(PyExc_BufferError, "results can only be exported with strides");
+		view->obj = NULL;
+		return -1;
+	}
+
+	/* Describe the array. */
+	view->obj = (PyObject *) self;
+	Py_INCREF(self);
+	view->buf = self->data;
+	view->len = self->shape[0] * self->shape[1] * sizeof(double);
+	view->readonly = 0;
+	view->itemsize = sizeof(double);
+	view->format = (flags & PyBUF_FORMAT) ? "d" : NULL;
+	view->ndim = 2;
+	view->shape = self->shape;
+	view->strides = self->strides;
+	view->suboffsets = NULL;
+	view->internal = NULL;
+
+	return 0;
+}
+
+static PySequenceMethods results_as_sequence = {
+	.sq_length = (lenfunc) results_length,
+};
+
+static PyBufferProcs results_as_buffer = {
+	.bf_getbuffer = (getbufferproc) results_getbuffer,
+};
+
+static PyTypeObject RESULTS_TYPE = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name = "trafficsim.Results",
+	.tp_doc = PyDoc_STR("Simulation results, use numpy.asarray() to get a (points, 12) array.\n"
+			"Columns are in the same order as trafficsim.COLUMNS. Arrival rates are the\n"
+			"requested values, so results[:, 1] == 0.3 selects rows with a rate of 0.3."),
+	.tp_basicsize = sizeof(RESULTS),
+	.tp_flags = Py_TPFLAGS_DEFAULT,
+	.tp_dealloc = (destructor) results_dealloc,
+	.tp_as_sequence = &results_as_sequence,
+	.tp_as_buffer = &results_as_buffer,
+};
+
+/* Create a new results object with room for some points. */
+static RESULTS *new_results(Py_ssize_t number_of_points) {
+	/* Check that the array size does not overflow. */
+	if (number_of_points > PY_SSIZE_T_MAX / NUMBER_OF_COLUMNS / (Py_ssize_t) sizeof(double)) {
+		PyErr_SetString(PyExc_OverflowError, "too many points");
+		return NULL;
+	}
+
+	/* Create results object. */
+	RESULTS *results = PyObject_New(RESULTS, &RESULTS_TYPE);
+	if (results == NULL) {
+		return NULL;
+	}
+
+	/* Allocate memory for values (at least one byte, so NULL means failure). */
+	results->data = PyMem_RawMalloc(number_of_points * NUMBER_OF_COLUMNS * sizeof(double) + 1);
+	if (results->data == NULL) {
+		Py_DECREF(results);
+		PyErr_NoMemory();
+		return NULL;
+	}
+
+	/* Set results attributes. */
+	results->shape[0] = number_of_points;
+	results->shape[1] = NUMBER_OF_COLUMNS;
+	results->strides[0] = sizeof(double);
+	results->strides[1] = number_of_points * sizeof(double);
+
+	/* Return new results. */
+	return results;
+}
+
+/* Get the i-th arrival rate of a sweep as a double. The product is rounded to
+ * 12 decimal places, so e.g. 3 * 0.1 gives 0.3 rather than 0.30000000000000004. */
+static double sweep_arrival_rate(double arrival_rate_step, unsigned int i) {
+	return floor((i + 1) * arrival_rate_step * 1e12 + 0.5) / 1e12;
+}
+
+/* Store a point in a row of a results object. Arrival rates are passed in
+ * separately as doubles, the floats in the point would not compare equal to
+ * the rates that were asked for (0.3 would be 0.30000001192092896). */
+static void save_point(RESULTS *results, Py_ssize_t row, POINT *point, double left_arrival_rate, double right_arrival_rate) {
+	double *column = results->data + row;
+	Py_ssize_t n = results->shape[0];
+
+	column[0 * n] = point->left_period;
+	column[1 * n] = left_arrival_rate;
+	column[2 * n] = point->right_period;
+	column[3 * n] = right_arrival_rate;
+	column[4 * n] = point->result.left_number_of_cars;
+	column[5 * n] = point->result.left_average_waiting_time;
+	column[6 * n] = point->result.left_maximum_waiting_time;
+	column[7 * n] = point->result.left_time_to_clear_queue;
+	column[8 * n] = point->result.right_number_of_cars;
+	column[9 * n] = point->result.right_average_waiting_time;
+	column[10 * n] = point->result.right_maximum_waiting_time;
+	column[11 * n] = point->result.right_time_to_clear_queue;
+}
+
+/* Check that a period and arrival rate are valid. */
+static int check_parameters(long period, double arrival_rate) {
+	if (period < 0 || period > UINT_MAX) {
+		PyErr_SetString(PyExc_ValueError, "period must be a non-negative integer");
+		return -1;
+	}
+	if (arrival_rate < 0 || arrival_rate > 1) {
+		PyErr_SetString(PyExc_ValueError, "arrival rate must be between 0 and 1");
+		return -1;
+	}
+	return 0;
+}
+
+/* Python: run_multiple_simulations(left_period, left_arrival_rate, right_period, right_arrival_rate) */
+static PyObject *py_run_multiple_simulations(PyObject *module, PyObject *args) {
+	long left_period, right_period;
+	double left_arrival_rate, right_arrival_rate;
+
+	/* Get and check arguments. */
+	if (!PyArg_ParseTuple(args, "ldld", &left_period, &left_arrival_rate, &right_period, &right_arrival_rate)) {
+		return NULL;
+	}
+	if (check_parameters(left_period, left_arrival_rate) != 0 || check_parameters(right_period, right_arrival_rate) != 0) {
+		return NULL;
+	}
+
+	/* Create results with room for one point. */
+	RESULTS *results = new_results(1);
+	if (results == NULL) {
+		return NULL;
+	}
+
+	POINT point;
+	point.left_period = left_period;
+	point.left_arrival_rate = left_arrival_rate;
+	point.right_period = right_period;
+	point.right_arrival_rate = right_arrival_rate;
+
+	/* Perform simulations without holding the GIL. */
+	Py_BEGIN_ALLOW_THREADS
+	PyThread_acquire_lock(SIMULATION_LOCK, WAIT_LOCK);
+
+	RESULT *average = run_multiple_simulations(point.left_period, point.left_arrival_rate,
+			point.right_period, point.right_arrival_rate);
+	point.result = *average;
+	free(average);
+
+	PyThread_release_lock(SIMULATION_LOCK);
+	Py_END_ALLOW_THREADS
+
+	/* Return results. */
+	save_point(results, 0, &point, left_arrival_rate, right_arrival_rate);
+	return (PyObject *) results;
+}
+
+/* Python: run_sweep(minimum_period=1, maximum_period=10, arrival_rate_step=0.1, number_of_arrival_rates=9) */
+static PyObject *py_run_sweep(PyObject *module, PyObject *args, PyObject *kwargs) {
+	static char *keywords[] = {"minimum_period", "maximum_period", "arrival_rate_step", "number_of_arrival_rates", NULL};
+
+	/* Start from the default sweep. */
+	SWEEP *defaults = new_sweep();
+	long minimum_period = defaults->minimum_period;
+	long maximum_period = defaults->maximum_period;
+	double arrival_rate_step = defaults->arrival_rate_step;
+	long number_of_arrival_rates = defaults->number_of_arrival_rates;
+	free(defaults);
+
+	/* Get and check arguments. */
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|lldl", keywords, &minimum_period, &maximum_period,
+				&arrival_rate_step, &number_of_arrival_rates)) {
+		return NULL;
+	}
+	if (check_parameters(minimum_period, 0) != 0 || check_parameters(maximum_period, 0) != 0) {
+		return NULL;
+	}
+	if (maximum_period < minimum_period) {
+		PyErr_SetString(PyExc_ValueError, "maximum period must not be less than minimum period");
+		return NULL;
+	}
+	if (number_of_arrival_rates < 1 || check_parameters(0, arrival_rate_step * number_of_arrival_rates) != 0) {
+		PyErr_SetString(PyExc_ValueError, "arrival rates must be between 0 and 1");
+		return NULL;
+	}
+
+	/* Check that the number of points fits in the sweep index. */
+	double number_of_periods = maximum_period - minimum_period + 1;
+	double number_of_points = number_of_periods * number_of_periods * number_of_arrival_rates * number_of_arrival_rates;
+	if (number_of_points > UINT_MAX) {
+		PyErr_SetString(PyExc_OverflowError, "too many points in sweep");
+		return NULL;
+	}
+
+	SWEEP sweep;
+	sweep.minimum_period = minimum_period;
+	sweep.maximum_period = maximum_period;
+	sweep.arrival_rate_step = arrival_rate_step;
+	sweep.number_of_arrival_rates = number_of_arrival_rates;
+
+	/* Create results with room for every point. */
+	RESULTS *results = new_results(sweep_size(&sweep));
+	if (results == NULL) {
+		return NULL;
+	}
+
+	/* Perform simulations without holding the GIL. */
+	Py_BEGIN_ALLOW_THREADS
+	PyThread_acquire_lock(SIMULATION_LOCK, WAIT_LOCK);
+
+	POINT point;
+	unsigned int index;
+	for (index = 0; index < sweep_size(&sweep); index++) {
+		run_sweep_point(&sweep, index, &point);
+
+		/* Get requested rates, in the same order as run_sweep_point. */
+		save_point(results, index, &point,
+				sweep_arrival_rate(arrival_rate_step, index / number_of_arrival_rates % number_of_arrival_rates),
+				sweep_arrival_rate(arrival_rate_step, index % number_of_arrival_rates));
+	}
+
+	PyThread_release_lock(SIMULATION_LOCK);
+	Py_END_ALLOW_THREADS
+
+	/* Return results. */
+	return (PyObject *) results;
+}
+
+/* Python: seed(value) */
+static PyObject *py_seed(PyObject *module, PyObject *args) {
+	unsigned long value;
+
+	/* Get arguments. */
+	if (!PyArg_ParseTuple(args, "k", &value)) {
+		return NULL;
+	}
+
+	/* Seed random number generator. */
+	Py_BEGIN_ALLOW_THREADS
+	PyThread_acquire_lock(SIMULATION_LOCK, WAIT_LOCK);
+	gsl_rng_set(RNG, value);
+	PyThread_release_lock(SIMULATION_LOCK);
+	Py_END_ALLOW_THREADS
+
+	Py_RETURN_NONE;
+}
+
+/* Python: set_options(simulation_cap=None, number_of_simulations=None, left_lanes=None, right_lanes=None,
+ *                     left_discharge_rate=None, right_discharge_rate=None) */
+static PyObject *py_set_options(PyObject *module, PyObject *args, PyObject *kwargs) {
+	static char *keywords[] = {"simulation_cap", "number_of_simulations", "left_lanes", "right_lanes",
+		"left_discharge_rate", "right_discharge_rate", NULL};
+	long simulation_cap = SIMULATION_CAP;
+	long number_of_simulations = NUMBER_OF_SIMULATIONS;
+	long left_lanes = LEFT_NUMBER_OF_LANES;
+	long right_lanes = RIGHT_NUMBER_OF_LANES;
+	double left_discharge_rate = LEFT_DISCHARGE_RATE;
+	double right_discharge_rate = RIGHT_DISCHARGE_RATE;
+
+	/* Get and check arguments. */
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|lllldd", keywords, &simulation_cap, &number_of_simulations,
+				&left_lanes, &right_lanes, &left_discharge_rate, &right_discharge_rate)) {
+		return NULL;
+	}
+	if (simulation_cap <= 0 || simulation_cap > MAXIMUM_SIMULATION_CAP || number_of_simulations <= 0 || number_of_simulations >= UINT_MAX
+			|| left_lanes <= 0 || left_lanes >= UINT_MAX || right_lanes <= 0 || right_lanes >= UINT_MAX) {
+		PyErr_SetString(PyExc_ValueError, "options must be positive integers");
+		return NULL;
+	}
+	if (!(left_discharge_rate > 0 && left_discharge_rate <= FLT_MAX) || !(right_discharge_rate > 0 && right_discharge_rate <= FLT_MAX)) {
+		PyErr_SetString(PyExc_ValueError, "discharge rates must be positive finite numbers");
+		return NULL;
+	}
+
+	/* Update options (not while a simulation is using them). */
+	Py_BEGIN_ALLOW_THREADS
+	PyThread_acquire_lock(SIMULATION_LOCK, WAIT_LOCK);
+	SIMULATION_CAP = simulation_cap;
+	NUMBER_OF_SIMULATIONS = number_of_simulations;
+	LEFT_NUMBER_OF_LANES = left_lanes;
+	RIGHT_NUMBER_OF_LANES = right_lanes;
+	LEFT_DISCHARGE_RATE = left_discharge_rate;
+	RIGHT_DISCHARGE_RATE = right_discharge_rate;
+	PyThread_release_lock(SIMULATION_LOCK);
+	Py_END_ALLOW_THREADS
+
+	Py_RETURN_NONE;
+}
+
+static PyMethodDef trafficsim_methods[] = {
+	{"run_multiple_simulations", (PyCFunction) py_run_multiple_simulations, METH_VARARGS,
+		PyDoc_STR("run_multiple_simulations(left_period, left_arrival_rate, right_period, right_arrival_rate)\n"
+				"Run the simulation for one set of parameters, return Results with one point.")},
+	{"run_sweep", (PyCFunction) (void (*)(void)) py_run_sweep, METH_VARARGS | METH_KEYWORDS,
+		PyDoc_STR("run_sweep(minimum_period=1, maximum_period=10, arrival_rate_step=0.1, number_of_arrival_rates=9)\n"
+				"Run the simulation for every combination of periods and arrival rates, return Results.")},
+	{"set_options", (PyCFunction) (void (*)(void)) py_set_options, METH_VARARGS | METH_KEYWORDS,
+		PyDoc_STR("set_options(simulation_cap=None, number_of_simulations=None, left_lanes=None, right_lanes=None,\n"
+				"            left_discharge_rate=None, right_discharge_rate=None)\n"
+				"Set when to cap each simulation, how many simulations to average over and the\n"
+				"number of lanes and discharge rate (cars per lane per green tick) of each approach.")},
+	{"seed", (PyCFunction) py_seed, METH_VARARGS,
+		PyDoc_STR("seed(value)\nSeed the random number generator.")},
+	{NULL, NULL, 0, NULL}
+};
+
+static struct PyModuleDef trafficsim_module = {
+	PyModuleDef_HEAD_INIT,
+	.m_name = "trafficsim",
+	.m_doc = PyDoc_STR("Python bindings for the traffic simulator."),
+	.m_size = -1,
+	.m_methods = trafficsim_methods,
+};
+
+/* Create the module. */
+PyMODINIT_FUNC PyInit_trafficsim(void) {
+	/* Setup results type. */
+	if (PyType_Ready(&RESULTS_TYPE) < 0) {
+		return NULL;
+	}
+
+	/* Create module. */
+	PyObject *module = PyModule_Create(&trafficsim_module);
+	if (module == NULL) {
+		return NULL;
+	}
+
+	/* Add results type and column names. */
+	Py_INCREF(&RESULTS_TYPE);
+	if (PyModule_AddObject(module, "Results", (PyObject *) &RESULTS_TYPE) < 0) {
+		Py_DECREF(&RESULTS_TYPE);
+		Py_DECREF(module);
+		return NULL;
+	}
+	PyObject *columns = Py_BuildValue("(ssssssssssss)", "Left Period", "Left Arrival Rate", "Right Period",
+			"Right Arrival Rate", "Left Number of Cars", "Left Average Waiting Time", "Left Maximum Waiting Time",
+			"Left Time to Clear", "Right Number of Cars", "Right Average Waiting Time",
+			"Right Maximum Waiting Time", "Right Time to Clear");
+	if (columns == NULL || PyModule_AddObject(module, "COLUMNS", columns) < 0) {
+		Py_XDECREF(columns);
+		Py_DECREF(module);
+		return NULL;
+	}
+
+	/* Setup lock and random number generator. */
+	SIMULATION_LOCK = PyThread_allocate_lock();
+	if (SIMULATION_LOCK == NULL) {
+		Py_DECREF(module);
+		return PyErr_NoMemory();
+	}
+	setup_rng();
+
+	/* Return module. */
+	return module;
+}
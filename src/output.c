@@ -0,0 +1,194 @@
+/* Compiler directives. */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <unistd.h>
+
+#include <output.h>
+
+/* Function definitions. */
+
+/* Get the fsync policy from a string. */
+FSYNC_POLICY get_fsync_policy(char *string) {
+	/* Compare string with the name of each policy. */
+	if (strcmp(string, "never") == 0) {
+		return FSYNC_NEVER;
+	}
+	else if (strcmp(string, "batch") == 0) {
+		return FSYNC_BATCH;
+	}
+	else if (strcmp(string, "close") == 0) {
+		return FSYNC_CLOSE;
+	}
+	else {
+		/* Unknown policy. */
+		fprintf(stderr, "Fatal! Invalid argument supplied (fsync policy not one of never, batch or close).\n");
+		exit(EINVAL);
+	}
+}
+
+/* Create a new output stage and start its writer thread. */
+OUTPUT_STAGE *new_output_stage(char *filename, FSYNC_POLICY fsync_policy) {
+	/* Allocate memory for output stage structure. */
+	OUTPUT_STAGE *stage = (OUTPUT_STAGE *) safe_malloc(sizeof(OUTPUT_STAGE));
+
+	/* Open file for appending. */
+	stage->file = fopen(filename, "a");
+
+	/* Check if file was opened successfully. */
+	if (stage->file == NULL) {
+		/* File was not opened successfully, report error and exit. */
+		perror("fopen");
+		fprintf(stderr, "Fatal! Could not open file for writing.\n");
+		exit(EIO);
+	}
+
+	/* Points are batched by the writer thread, so disable stdio buffering. */
+	setvbuf(stage->file, NULL, _IONBF, 0);
+
+	/* Set output stage attributes. */
+	stage->fsync_policy = fsync_policy;
+
+	stage->head = 0;
+	stage->tail = 0;
+
+	stage->buffer_length = 0;
+
+	/* Setup semaphores, all slots start free. */
+	if (sem_init(&stage->free_slots, 0, OUTPUT_QUEUE_CAPACITY) != 0 || sem_init(&stage->filled_slots, 0, 0) != 0) {
+		perror("sem_init");
+		exit(EXIT_FAILURE);
+	}
+
+	/* Start writer thread. */
+	if (pthread_create(&stage->writer, NULL, write_points, stage) != 0) {
+		fprintf(stderr, "Fatal! Could not start writer thread.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	/* Return new output stage. */
+	return stage;
+}
+
+/* Fill the slot at the tail of the queue. Only waits if the queue is full. */
+void push_slot(OUTPUT_STAGE *stage, POINT *point, BOOL last) {
+	/* Wait for a free slot. */
+	while (sem_wait(&stage->free_slots) != 0) {
+		/* Interrupted by a signal, try again. */
+	}
+
+	/* Copy point (if any) into slot at the tail of the queue. */
+	if (point != NULL) {
+		stage->queue[stage->tail].point = *point;
+	}
+	stage->queue[stage->tail].last = last;
+	stage->tail = (stage->tail + 1) % OUTPUT_QUEUE_CAPACITY;
+
+	/* Hand slot over to the writer thread. */
+	sem_post(&stage->filled_slots);
+}
+
+/* Pass a point to the writer thread. */
+void push_point(OUTPUT_STAGE *stage, POINT *point) {
+	push_slot(stage, point, false);
+}
+
+/* Write all remaining points, stop the writer thread and close the file. */
+void close_output_stage(OUTPUT_STAGE *stage) {
+	/* Tell the writer thread to stop once it reaches the last slot. */
+	push_slot(stage, NULL, true);
+
+	/* Wait for writer thread to finish. */
+	pthread_join(stage->writer, NULL);
+
+	/* Write anything left in the buffer. */
+	flush_output_buffer(stage);
+	if (stage->fsync_policy == FSYNC_CLOSE) {
+		sync_output_file(stage);
+	}
+
+	/* Close the file. */
+	fclose(stage->file);
+
+	/* Free allocated memory. */
+	sem_destroy(&stage->free_slots);
+	sem_destroy(&stage->filled_slots);
+	free(stage);
+}
+
+/* Writer thread, formats points from the queue into the output buffer. */
+void *write_points(void *argument) {
+	OUTPUT_STAGE *stage = (OUTPUT_STAGE *) argument;
+
+	while (true) {
+		/* Wait for a filled slot. */
+		while (sem_wait(&stage->filled_slots) != 0) {
+			/* Interrupted by a signal, try again. */
+		}
+
+		/* Check slot at the head of the queue. */
+		OUTPUT_SLOT *slot = &stage->queue[stage->head];
+		if (slot->last) {
+			/* No more points will arrive. */
+			return NULL;
+		}
+
+		/* Make room in the buffer if the next point might not fit. */
+		if (stage->buffer_length + OUTPUT_LINE_LENGTH > OUTPUT_BUFFER_SIZE) {
+			flush_output_buffer(stage);
+		}
+
+		/* Format point at the head of the queue into the buffer. */
+		stage->buffer_length += format_point_csv(stage->buffer + stage->buffer_length, &slot->point);
+		stage->head = (stage->head + 1) % OUTPUT_QUEUE_CAPACITY;
+
+		/* Hand slot back to the producer. */
+		sem_post(&stage->free_slots);
+	}
+}
+
+/* Format a point in CSV format, return the number of characters written. */
+unsigned int format_point_csv(char *buffer, POINT *point) {
+	RESULT *result = &point->result;
+
+	return sprintf(buffer, "%d,%.2f,%d,%.2f,%d,%.2f,%d,%d,%d,%.2f,%d,%d,\n",
+			point->left_period, point->left_arrival_rate, point->right_period, point->right_arrival_rate,
+			result->left_number_of_cars, result->left_average_waiting_time,
+			result->left_maximum_waiting_time, result->left_time_to_clear_queue,
+			result->right_number_of_cars, result->right_average_waiting_time,
+			result->right_maximum_waiting_time, result->right_time_to_clear_queue);
+}
+
+/* Write the output buffer to the file in one go. */
+void flush_output_buffer(OUTPUT_STAGE *stage) {
+	/* Check buffer state. */
+	if (stage->buffer_length == 0) {
+		/* Nothing to write. */
+		return;
+	}
+
+	/* Write buffer to file. */
+	if (fwrite(stage->buffer, 1, stage->buffer_length, stage->file) != stage->buffer_length) {
+		/* Write failed, report error and exit. */
+		perror("fwrite");
+		fprintf(stderr, "Fatal! Could not write to file.\n");
+		exit(EIO);
+	}
+
+	/* Empty the buffer. */
+	stage->buffer_length = 0;
+
+	/* Flush to disk if required. */
+	if (stage->fsync_policy == FSYNC_BATCH) {
+		sync_output_file(stage);
+	}
+}
+
+/* Flush everything written to the file to disk. */
+void sync_output_file(OUTPUT_STAGE *stage) {
+	if (fsync(fileno(stage->file)) != 0) {
+		perror("fsync");
+		fprintf(stderr, "Fatal! Could not flush file to disk.\n");
+		exit(EIO);
+	}
+}
@@ -0,0 +1,73 @@
+/* Compiler directives. */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+#ifndef __RUNSIMULATIONS_H
+#define __RUNSIMULATIONS_H
+#include <runSimulations.h>
+#endif
+
+/* Number of points the output queue can hold before the producer waits. */
+#define OUTPUT_QUEUE_CAPACITY 1024
+
+/* Size of the buffer used to batch writes to the output file. */
+#define OUTPUT_BUFFER_SIZE 65536
+
+/* Maximum length of a single point in CSV format. */
+#define OUTPUT_LINE_LENGTH 1024
+
+/* Structure definitions. */
+
+/* Fsync policies, used for deciding when output is flushed to disk. */
+typedef enum {FSYNC_NEVER, FSYNC_BATCH, FSYNC_CLOSE} FSYNC_POLICY;
+
+/* Output slot structure, used for passing a point to the writer thread. The
+ * last slot pushed carries no point and tells the writer thread to stop. */
+struct output_slot {
+	POINT point;
+	BOOL last;
+};
+typedef struct output_slot OUTPUT_SLOT;
+
+/* Output stage structure, used for writing points on a separate thread.
+ *
+ * Points are passed from the simulation thread to the writer thread through
+ * a bounded ring buffer with one producer and one consumer. The semaphores
+ * count free and filled slots, so neither side ever takes a lock, and points
+ * are written in the order they were pushed. The producer only touches the
+ * tail and the writer thread only touches the head. The writer thread formats
+ * points into a large buffer and only writes to the file once it is full. */
+struct output_stage {
+	FILE *file;
+	FSYNC_POLICY fsync_policy;
+
+	OUTPUT_SLOT queue[OUTPUT_QUEUE_CAPACITY];
+	unsigned int head;
+	unsigned int tail;
+	sem_t free_slots;
+	sem_t filled_slots;
+
+	char buffer[OUTPUT_BUFFER_SIZE];
+	unsigned int buffer_length;
+
+	pthread_t writer;
+};
+typedef struct output_stage OUTPUT_STAGE;
+
+/* Function prototypes. */
+
+FSYNC_POLICY get_fsync_policy(char *string);
+
+OUTPUT_STAGE *new_output_stage(char *filename, FSYNC_POLICY fsync_policy);
+void push_slot(OUTPUT_STAGE *stage, POINT *point, BOOL last);
+void push_point(OUTPUT_STAGE *stage, POINT *point);
+void close_output_stage(OUTPUT_STAGE *stage);
+
+void *write_points(void *argument);
+unsigned int format_point_csv(char *buffer, POINT *point);
+void flush_output_buffer(OUTPUT_STAGE *stage);
+void sync_output_file(OUTPUT_STAGE *stage);
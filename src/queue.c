@@ -4,103 +4,104 @@
 
 /* Function definitions. */
 
-/* Create a new node. */
-NODE *new_node(void *data) {
-	/* Allocate memory for node structure. */
-	NODE *node = (NODE *) safe_malloc(sizeof(NODE));
+/* Create a new array queue with room for some values, it grows when needed. */
+ARRAY_QUEUE *new_array_queue(size_t capacity) {
+	/* Check that the size of the array does not overflow. */
+	if (capacity == 0 || capacity > ((size_t) -1) / sizeof(unsigned int)) {
+		fprintf(stderr, "Fatal! Invalid array queue capacity.\n");
+		exit(EXIT_FAILURE);
+	}
 
-	/* Set node attributes. */
-	node->next = NULL;
-	node->data = data;
+	/* Allocate memory for array queue structure and its values. */
+	ARRAY_QUEUE *queue = (ARRAY_QUEUE *) safe_malloc(sizeof(ARRAY_QUEUE));
+	queue->data = (unsigned int *) safe_malloc(capacity * sizeof(unsigned int));
 
-	/* Return new node. */
-	return node;
-}
+	/* Set array queue attributes. */
+	queue->capacity = capacity;
+	queue->head = 0;
+	queue->tail = 0;
 
-/* Create a new queue. */
-QUEUE *new_queue() {
-	/* Allocate memory for queue structure. */
-	QUEUE *queue = (QUEUE *) safe_malloc(sizeof(QUEUE));
+	/* Return new array queue. */
+	return queue;
+}
 
-	/* Set queue attributes. */
-	queue->head = NULL;
-	queue->tail = NULL;
+/* Check if an array queue is empty. */
+BOOL is_array_queue_empty(ARRAY_QUEUE *queue) {
+	return queue->head == queue->tail;
+}
 
-	/* Return new queue. */
-	return queue;
+/* Get the number of values in an array queue. */
+size_t array_queue_length(ARRAY_QUEUE *queue) {
+	return queue->tail - queue->head;
 }
 
-/* Check if a queue is empty. */
-BOOL is_empty(QUEUE *queue) {
-	/* Use the head and tail pointers to check the state of the queue. */
-	if (queue->head == NULL && queue->tail == NULL) {
-		/* Head and tail pointers are not set, queue is empty. */
-		return true;
+/* Make room at the end of a full array queue. */
+void make_room_in_array_queue(ARRAY_QUEUE *queue) {
+	size_t length = array_queue_length(queue);
+
+	/* Grow the array if more than half of it is in use, otherwise moving the
+	 * values to the front frees enough room. Either way each value is only
+	 * moved a constant number of times on average. */
+	if (length > queue->capacity / 2) {
+		/* Check that the size of the array does not overflow. */
+		if (queue->capacity > ((size_t) -1) / 2 / sizeof(unsigned int)) {
+			fprintf(stderr, "Fatal! Array queue is too large.\n");
+			exit(ENOMEM);
+		}
+
+		/* Double the size of the array. */
+		queue->capacity *= 2;
+		queue->data = (unsigned int *) safe_realloc(queue->data, queue->capacity * sizeof(unsigned int));
 	}
-	else {
-		/* Queue is not empty. */
-		return false;
+
+	/* Move values to the front of the array, dropping those already dequeued. */
+	if (queue->head > 0) {
+		memmove(queue->data, queue->data + queue->head, length * sizeof(unsigned int));
+		queue->head = 0;
+		queue->tail = length;
 	}
 }
 
-/* Add some data to the tail of the queue. */
-void enqueue(QUEUE *queue, void *data) {
-	/* Create a new node with the given data. */
-	NODE *node = new_node(data);
-
+/* Add a value to the tail of an array queue. */
+void array_enqueue(ARRAY_QUEUE *queue, unsigned int value) {
 	/* Check queue state. */
-	if (is_empty(queue)) {
-		/* Queue is empty, set head and tail to point to node. */ 
-		queue->head = node;
-		queue->tail = node;
-	}
-	else {
-		/* Queue is not empty, add node to end of queue. */
-		queue->tail->next = node;
-		queue->tail = node;
+	if (queue->tail == queue->capacity) {
+		/* No room left at the end of the array. */
+		make_room_in_array_queue(queue);
 	}
+
+	/* Add value to end of queue. */
+	queue->data[queue->tail] = value;
+	queue->tail++;
 }
 
-/* Return the data of the node at the head of the queue. */
-void *dequeue(QUEUE *queue) {
+/* Remove n values from the head of an array queue, return a pointer to them.
+ * The values stay valid until the next value is enqueued. */
+unsigned int *array_dequeue_span(ARRAY_QUEUE *queue, size_t n) {
 	/* Check queue state. */
-	if (!(is_empty(queue))) {
-		/* Get node from head of queue and get data from node. */
-		NODE *node = queue->head;
-		void *data = node->data;
-
-		/* Update queue head to point to the next node. */
-		queue->head = queue->head->next;
-
-		/* Check queue state. */
-		if (queue->head == NULL) {
-			/* Queue has been emptied. */
-			queue->tail = NULL;
-		}
+	if (n > array_queue_length(queue)) {
+		/* Attempting to dequeue more values than there are, throw error. */
+		fprintf(stderr, "Fatal! Attempting to dequeue more values than an array queue holds.\n");
+		exit(EXIT_FAILURE);
+	}
 
-		/* Free memory used by node. */
-		free(node);
+	/* Get span from head of queue and move head past it. */
+	unsigned int *span = queue->data + queue->head;
+	queue->head += n;
 
-		/* Return data from node. */
-		return data;
-	}
-	else {
-		/* Attempting to dequeue items from empty queue, throw error. */
-		fprintf(stderr, "Fatal! Attempting to dequeue an empty queue.\n");
-		exit(EXIT_FAILURE);
+	/* Check queue state. */
+	if (queue->head == queue->tail) {
+		/* Queue has been emptied, start again from the front of the array. */
+		queue->head = 0;
+		queue->tail = 0;
 	}
+
+	/* Return span. */
+	return span;
 }
 
-/* Print a queue, node-wise. Shows pointers rather than actual data. */
-void print_queue(NODE *node) {
-	/* Check the current node. */
-	if (node == NULL) {
-		/* Node doesn't exist, end of queue. */
-		printf("\n");
-	}
-	else {
-		/* Node exists, print pointer and recurse to next node. */
-		printf("%p -> ", node);
-		print_queue(node->next);
-	}
+/* Free an array queue and its values. */
+void free_array_queue(ARRAY_QUEUE *queue) {
+	free(queue->data);
+	free(queue);
 }
@@ -3,33 +3,35 @@
 #include <errno.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #ifndef __UTIL_H
 #define __UTIL_H
 #include <util.h>
 #endif
 
-/* Structure definitions. */
+/* Number of values an array queue starts with room for. */
+#define ARRAY_QUEUE_INITIAL_CAPACITY 64
 
-/* Node structure, used for storing individual pieces of data. */
-struct node {
-	void *data;
-	struct node *next;
-};
-typedef struct node NODE;
+/* Structure definitions. */
 
-/* Queue structure, used for storing multiple nodes. */
-struct queue {
-	NODE *head;
-	NODE *tail;
+/* Array queue structure, used for storing unsigned integers contiguously.
+ * The array grows with the number of values held (not the number ever added),
+ * and values dequeued together are always one span. */
+struct array_queue {
+	unsigned int *data;
+	size_t capacity;
+	size_t head;
+	size_t tail;
 };
-typedef struct queue QUEUE;
+typedef struct array_queue ARRAY_QUEUE;
 
 /* Function prototypes. */
 
-NODE *new_node(void *data);
-QUEUE *new_queue();
-BOOL is_empty(QUEUE *queue);
-void enqueue(QUEUE *queue, void *data);
-void *dequeue(QUEUE *queue);
-void print_queue(NODE *node);
+ARRAY_QUEUE *new_array_queue(size_t capacity);
+BOOL is_array_queue_empty(ARRAY_QUEUE *queue);
+size_t array_queue_length(ARRAY_QUEUE *queue);
+void make_room_in_array_queue(ARRAY_QUEUE *queue);
+void array_enqueue(ARRAY_QUEUE *queue, unsigned int value);
+unsigned int *array_dequeue_span(ARRAY_QUEUE *queue, size_t n);
+void free_array_queue(ARRAY_QUEUE *queue);
@@ -1,55 +1,153 @@
 /* Compiler directives. */
 
+#ifndef __RUNSIMULATIONS_H
+#define __RUNSIMULATIONS_H
 #include <runSimulations.h>
+#endif
 
-/* Main program. */
+#include <output.h>
 
+/* Global variables. */
+
+/* Random number generator. */
+gsl_rng *RNG;
+
+/* Number of simulations to run. */
+unsigned int NUMBER_OF_SIMULATIONS = DEFAULT_NUMBER_OF_SIMULATIONS;
+
+/* When to cap the simulation (no new arrivals after this tick). */
+unsigned int SIMULATION_CAP = DEFAULT_SIMULATION_CAP;
+
+/* Output CSV file. */
+char *OUTPUT_CSV_FILE = DEFAULT_OUTPUT_CSV_FILE;
+
+/* Number of lanes on the left and right approaches. */
+unsigned int LEFT_NUMBER_OF_LANES = DEFAULT_NUMBER_OF_LANES;
+unsigned int RIGHT_NUMBER_OF_LANES = DEFAULT_NUMBER_OF_LANES;
+
+/* Number of cars each lane discharges per green tick (saturation flow). */
+float LEFT_DISCHARGE_RATE = DEFAULT_DISCHARGE_RATE;
+float RIGHT_DISCHARGE_RATE = DEFAULT_DISCHARGE_RATE;
+
+/* Main program, left out when building as a library (e.g. Python bindings). */
+
+#ifndef SIMULATION_LIBRARY
 int main(int argc, char *argv[]) {
 	/* Setup random number generator. */
 	setup_rng();
 
-	/* Create variables for running simulations. */
-	unsigned int left_period = 0;
-	float left_arrival_rate = 0;
-	unsigned int right_period = 0;
-	float right_arrival_rate = 0;
+	/* Create variables for options. */
+	BOOL verbose = true;
+	BOOL sweep_mode = false;
+	FSYNC_POLICY fsync_policy = FSYNC_NEVER;
+	int i = 1;
+
+	/* Get command line options. */
+	while (i < argc && strncmp(argv[i], "--", 2) == 0) {
+		if (strcmp(argv[i], "--quiet") == 0) {
+			/* Don't show results for each point. */
+			verbose = false;
+		}
+		else if (strcmp(argv[i], "--sweep") == 0) {
+			/* Run every point in the default sweep. */
+			sweep_mode = true;
+		}
+		else if (strcmp(argv[i], "--fsync") == 0 && i + 1 < argc) {
+			/* Get fsync policy for output file. */
+			fsync_policy = get_fsync_policy(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--cap") == 0 && i + 1 < argc) {
+			/* Get point at which to cap the simulation. */
+			SIMULATION_CAP = get_count(argv[++i]);
+			if (SIMULATION_CAP > MAXIMUM_SIMULATION_CAP) {
+				fprintf(stderr, "Fatal! Invalid argument supplied (cap was too large).\n");
+				exit(EINVAL);
+			}
+		}
+		else if (strcmp(argv[i], "--simulations") == 0 && i + 1 < argc) {
+			/* Get number of simulations to run. */
+			NUMBER_OF_SIMULATIONS = get_count(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+			/* Get output CSV file. */
+			OUTPUT_CSV_FILE = argv[++i];
+		}
+		else if (strcmp(argv[i], "--left-lanes") == 0 && i + 1 < argc) {
+			/* Get number of lanes on the left approach. */
+			LEFT_NUMBER_OF_LANES = get_count(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--right-lanes") == 0 && i + 1 < argc) {
+			/* Get number of lanes on the right approach. */
+			RIGHT_NUMBER_OF_LANES = get_count(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--left-discharge-rate") == 0 && i + 1 < argc) {
+			/* Get discharge rate of the left approach. */
+			LEFT_DISCHARGE_RATE = get_discharge_rate(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--right-discharge-rate") == 0 && i + 1 < argc) {
+			/* Get discharge rate of the right approach. */
+			RIGHT_DISCHARGE_RATE = get_discharge_rate(argv[++i]);
+		}
+		else {
+			/* Unknown option (or option missing its value). */
+			fprintf(stderr, "Fatal! Invalid option supplied (%s).\n", argv[i]);
+			exit(EINVAL);
+		}
+		i++;
+	}
 
-	/* Get command line arguments. */
-	if (!(argc == 5)) {
+	/* Check number of remaining arguments. */
+	if (!(argc - i == (sweep_mode ? 0 : 4))) {
 		/* Invalid number of arguments supplied. */
 		fprintf(stderr, "Fatal! Incorrect number of arguments supplied.\n");
 		exit(EINVAL);
 	}
-	else {
-		/* Get periods and arrival rates. */
-		left_period = get_period(argv[1]);
-		left_arrival_rate = get_arrival_rate(argv[2]);
-		right_period = get_period(argv[3]);
-		right_arrival_rate = get_arrival_rate(argv[4]);
-	}
 
-	/* Perform simulations. */
-	RESULT *average = run_multiple_simulations(left_period, left_arrival_rate, right_period, right_arrival_rate);
-
-	/* Show information about parameter values. */
-	printf("Parameter values:\n");
-	printf("\tFrom left:\n");
-	printf("\t\tTraffic light period: %d\n", left_period);
-	printf("\t\tTraffic arrival rate: %.2f\n", left_arrival_rate);
-	printf("\tFrom right:\n");
-	printf("\t\tTraffic light period: %d\n", right_period);
-	printf("\t\tTraffic arrival rate: %.2f\n", right_arrival_rate);
+	/* Start writing results in the background. */
+	OUTPUT_STAGE *stage = new_output_stage(OUTPUT_CSV_FILE, fsync_policy);
+	POINT point;
 
-	/* Show results. */
-	output_result_statistics(average);
+	/* Perform simulations. */
+	if (sweep_mode) {
+		/* Run every point in the sweep. */
+		SWEEP *sweep = new_sweep();
+		unsigned int index;
+		for (index = 0; index < sweep_size(sweep); index++) {
+			/* Perform simulations for one point and output results. */
+			run_sweep_point(sweep, index, &point);
+			push_point(stage, &point);
+			if (verbose) {
+				output_point_statistics(&point);
+			}
+		}
 
-	/* Output data in CSV format. */
-	output_result_statistics_csv(average, left_period, left_arrival_rate, right_period, right_arrival_rate);
+		/* Free sweep. */
+		free(sweep);
+	}
+	else {
+		/* Get periods and arrival rates. */
+		point.left_period = get_period(argv[i]);
+		point.left_arrival_rate = get_arrival_rate(argv[i + 1]);
+		point.right_period = get_period(argv[i + 2]);
+		point.right_arrival_rate = get_arrival_rate(argv[i + 3]);
+
+		/* Perform simulations for the point. */
+		RESULT *average = run_multiple_simulations(point.left_period, point.left_arrival_rate,
+				point.right_period, point.right_arrival_rate);
+		point.result = *average;
+		free(average);
+
+		/* Output results. */
+		push_point(stage, &point);
+		if (verbose) {
+			output_point_statistics(&point);
+		}
+	}
 
 	/* Free allocated memory. */
 
-	/* Free average. */
-	free(average);
+	/* Finish writing results and free output stage. */
+	close_output_stage(stage);
 
 	/* Free random number generator. */
 	gsl_rng_free(RNG);
@@ -57,6 +155,7 @@ int main(int argc, char *argv[]) {
 	/* Exit program. */
 	return 0;
 }
+#endif
 
 /* Function definitions. */
 
@@ -73,7 +172,7 @@ void setup_rng() {
 }
 
 /* Generate random number in the range [0, 1). */
-double random() {
+double random_uniform() {
 	/* Use GSL to return random number. */
 	return gsl_rng_uniform(RNG);
 }
@@ -84,6 +183,12 @@ float running_average(float average, unsigned int n, unsigned int x) {
 	return ((average * n) + x) / (n + 1);
 }
 
+/* Return a running average after adding k values which sum to total. */
+float running_average_bulk(float average, unsigned int n, double total, unsigned int k) {
+	/* Calculate and return average. */
+	return ((average * n) + total) / (n + k);
+}
+
 /* Get the period from a string. */
 unsigned int get_period(char *string) {
 	/* Create variables. */
@@ -115,6 +220,37 @@ unsigned int get_period(char *string) {
 	return period;
 }
 
+/* Get a (non-zero) count from a string, used for options. */
+unsigned int get_count(char *string) {
+	/* Create variables. */
+	char *endptr;
+	errno = 0;
+
+	/* Attempt to get count from string using base 10. */
+	long count = strtol(string, &endptr, 10);
+
+	/* Failure occurred (where?). */
+	if (errno != 0) {
+		perror("strtol");
+		exit(EXIT_FAILURE);
+	}
+
+	/* String has no digits. */
+	if (endptr == string) {
+		fprintf(stderr, "Fatal! No digits found.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	/* Count is not positive (or too large to run). */
+	if (count <= 0 || count >= UINT_MAX) {
+		fprintf(stderr, "Fatal! Invalid argument supplied (count was not positive).\n");
+		exit(EINVAL);
+	}
+
+	/* Return the count. */
+	return count;
+}
+
 /* Get the arrival rate from a string. */
 float get_arrival_rate(char *string) {
 	/* Create variables. */
@@ -146,20 +282,39 @@ float get_arrival_rate(char *string) {
 	return arrival_rate;
 }
 
-/* Create a new car. */
-CAR *new_car(unsigned int arrival_time) {
-	/* Allocate memory for car structure. */
-	CAR *car = (CAR *) safe_malloc(sizeof(CAR));
-	
-	/* Set car attributes. */
-	car->arrival_time = arrival_time;
+/* Get the discharge rate from a string. */
+float get_discharge_rate(char *string) {
+	/* Create variables. */
+	char *endptr;
+	errno = 0;
+
+	/* Attempt to get discharge rate from string. */
+	double discharge_rate = strtod(string, &endptr);
+
+	/* Failure occurred (where?). */
+	if (errno != 0) {
+		perror("strtod");
+		exit(EXIT_FAILURE);
+	}
+
+	/* String has no digits. */
+	if (endptr == string) {
+		fprintf(stderr, "Fatal! No digits found.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	/* Discharge rate not positive or not finite (also rejects NaN). */
+	if (!(discharge_rate > 0 && discharge_rate <= FLT_MAX)) {
+		fprintf(stderr, "Fatal! Invalid argument supplied (discharge rate was not a positive number).\n");
+		exit(EINVAL);
+	}
 
-	/* Return new car. */
-	return car;
+	/* Return the discharge rate. */
+	return discharge_rate;
 }
 
 /* Create a new traffic light. */
-TRAFFIC_LIGHT *new_traffic_light(unsigned int period, float arrival_rate) {
+TRAFFIC_LIGHT *new_traffic_light(unsigned int period, float arrival_rate, unsigned int number_of_lanes, float discharge_rate) {
 	/* Allocate memory for traffic light structure. */
 	TRAFFIC_LIGHT *traffic_light = (TRAFFIC_LIGHT *) safe_malloc(sizeof(TRAFFIC_LIGHT));
 
@@ -167,7 +322,11 @@ TRAFFIC_LIGHT *new_traffic_light(unsigned int period, float arrival_rate) {
 	traffic_light->period = period;
 	traffic_light->arrival_rate = arrival_rate;
 
-	traffic_light->queue = new_queue();
+	traffic_light->number_of_lanes = number_of_lanes;
+	traffic_light->discharge_rate = discharge_rate;
+	traffic_light->discharge_capacity = 0;
+
+	traffic_light->queue = new_array_queue(ARRAY_QUEUE_INITIAL_CAPACITY);
 	traffic_light->is_green = false;
 
 	traffic_light->number_of_cars = 0;
@@ -200,6 +359,22 @@ RESULT *new_result() {
 	return result;
 }
 
+/* Create a new sweep over the same grid as extras/generateCSV. */
+SWEEP *new_sweep() {
+	/* Allocate memory for sweep structure. */
+	SWEEP *sweep = (SWEEP *) safe_malloc(sizeof(SWEEP));
+
+	/* Set sweep attributes. */
+	sweep->minimum_period = 1;
+	sweep->maximum_period = 10;
+
+	sweep->arrival_rate_step = 0.1;
+	sweep->number_of_arrival_rates = 9;
+
+	/* Return new sweep. */
+	return sweep;
+}
+
 /* Save the result of a simulation to a structure. */
 RESULT *save_result(TRAFFIC_LIGHT *left, TRAFFIC_LIGHT *right) {
 	/* Allocate memory for result structure. */
@@ -223,24 +398,23 @@ RESULT *save_result(TRAFFIC_LIGHT *left, TRAFFIC_LIGHT *right) {
 /* Add a car to a traffic lights queue. */
 void add_car_to_traffic_light(unsigned int count, TRAFFIC_LIGHT *traffic_light) {
 	/* Compare arrival rate with a random number. */
-	if (traffic_light->arrival_rate > random()) {
-		/* Create a new car and add it to the traffic lights queue. */
-		CAR *car = new_car(count);
-		enqueue(traffic_light->queue, car);
+	if (traffic_light->arrival_rate > random_uniform()) {
+		/* Add the arrival time of a new car to the traffic lights queue. */
+		array_enqueue(traffic_light->queue, count);
 	}
 }
 
-/* Drive a car through the traffic lights. */
+/* Drive a car through the traffic lights (one lane, one car per tick). */
 void drive_car_through_traffic_light(unsigned int count, TRAFFIC_LIGHT *traffic_light) {
 	/* Check queue of traffic light. */
-	if (!(is_empty(traffic_light->queue))) {
+	if (!(is_array_queue_empty(traffic_light->queue))) {
 		/* Queue is not empty, drive car through. */
-		CAR *car = dequeue(traffic_light->queue);
+		unsigned int arrival_time = *array_dequeue_span(traffic_light->queue, 1);
 
 		/* Update statistics. */
 
 		/* Update maximum waiting time. */
-		unsigned int waiting_time = count - car->arrival_time;
+		unsigned int waiting_time = count - arrival_time;
 		if (waiting_time > traffic_light->maximum_waiting_time) {
 			traffic_light->maximum_waiting_time = waiting_time;
 		}
@@ -251,22 +425,96 @@ void drive_car_through_traffic_light(unsigned int count, TRAFFIC_LIGHT *traffic_
 
 		/* Update number of cars. */
 		traffic_light->number_of_cars++;
+	}
+}
 
-		/* Free allocated memory. */
-		free(car);
+/* Drive as many cars through the traffic lights as its lanes can discharge. */
+void drive_cars_through_traffic_light(unsigned int count, TRAFFIC_LIGHT *traffic_light) {
+	/* Add this tick's discharge, only whole cars can drive through. */
+	traffic_light->discharge_capacity += traffic_light->number_of_lanes * traffic_light->discharge_rate;
+	unsigned int length = array_queue_length(traffic_light->queue);
+	unsigned int k;
+
+	/* Compare as floats first, the capacity may not fit in an integer. */
+	if (traffic_light->discharge_capacity >= length + 1.0f) {
+		/* Every waiting car can drive through, unused capacity is lost. */
+		k = length;
+		traffic_light->discharge_capacity = 0;
+	}
+	else {
+		/* Carry over part of a car to the next green tick (even across a red
+		 * phase, so short greens still discharge). */
+		k = traffic_light->discharge_capacity;
+		traffic_light->discharge_capacity -= k;
+	}
+	if (k == 0) {
+		return;
 	}
+
+	/* Drive cars through, arrival times are contiguous and in order. */
+	unsigned int *arrival_times = array_dequeue_span(traffic_light->queue, k);
+
+	/* Update statistics. */
+
+	/* Update maximum waiting time, the first car has waited the longest. */
+	unsigned int waiting_time = count - arrival_times[0];
+	if (waiting_time > traffic_light->maximum_waiting_time) {
+		traffic_light->maximum_waiting_time = waiting_time;
+	}
+
+	/* Update average, summing in a double as k long waits can overflow an integer. */
+	double total_waiting_time = 0;
+	unsigned int i;
+	for (i = 0; i < k; i++) {
+		total_waiting_time += count - arrival_times[i];
+	}
+	traffic_light->average_waiting_time = running_average_bulk(traffic_light->average_waiting_time,
+			traffic_light->number_of_cars, total_waiting_time, k);
+
+	/* Update number of cars. */
+	traffic_light->number_of_cars += k;
 }
 
-/* Update the time taken to clear a traffic light. */
-void update_time_to_clear_traffic_light(unsigned int count, TRAFFIC_LIGHT *traffic_light) {
+/* Update the time taken to clear a traffic light (time is ticks since the cap). */
+void update_time_to_clear_traffic_light(unsigned int time, TRAFFIC_LIGHT *traffic_light) {
 	/* Check if queue is empty and flag has not been set. */
-	if (is_empty(traffic_light->queue) && !(traffic_light->queue_cleared)) {
+	if (is_array_queue_empty(traffic_light->queue) && !(traffic_light->queue_cleared)) {
 		/* Update time to clear queue. */
-		traffic_light->time_to_clear_queue = count - SIMULATION_CAP;
+		traffic_light->time_to_clear_queue = time;
 		traffic_light->queue_cleared = true;
 	}
 }
 
+/* Change which traffic light is green and reset the light counter. */
+void change_traffic_lights(TRAFFIC_LIGHT *left, TRAFFIC_LIGHT *right, unsigned int *light_counter) {
+	/* Check which light is currently green. */
+	if (left->is_green) {
+		/* Left light green, reverse lights. */
+		left->is_green = false;
+		right->is_green = true;
+
+		/* Update counter for switching lights to right light period. */
+		*light_counter = right->period + 1;
+	}
+	else if (right->is_green) {
+		/* Right light green, reverse lights. */
+		right->is_green = false;
+		left->is_green = true;
+
+		/* Update counter for switching lights to left light period. */
+		*light_counter = left->period + 1;
+	}
+}
+
+/* Check if simulation has somehow entered an erroneous state. */
+void check_traffic_lights(TRAFFIC_LIGHT *left, TRAFFIC_LIGHT *right) {
+	if (left->is_green == right->is_green) {
+		/* Somehow (?) both traffic lights are the same. */ 
+		fprintf(stderr, "Fatal! Simulation has entered erroneous state (traffic lights in same state).\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
 /* Output statistics for traffic lights. */
 void output_traffic_light_statistics(TRAFFIC_LIGHT *traffic_light) {
 	printf("Number of cars: %d\n", traffic_light->number_of_cars);
@@ -292,137 +540,208 @@ void output_result_statistics(RESULT *result) {
 	printf("\t\tTime to clear queue: %d\n", result->right_time_to_clear_queue);
 }
 
-/* Output statistics from a result to a CSV file. */
-void output_result_statistics_csv(RESULT *result, unsigned int left_period, float left_arrival_rate, unsigned int right_period, float right_arrival_rate) {
-	/* Open file for appending. */
-	FILE *f = fopen(OUTPUT_CSV_FILE, "a");
-
-	/* Check if file was opened successfully. */
-	if (f == NULL) {
-		/* File was not opened successfully, report error and exit. */
-		perror("fopen");
-		fprintf(stderr, "Fatal! Could not open file for writing.\n");
-		exit(EIO);
-	}
-
-	/* Append results to file. */
-	fprintf(f, "%d,%.2f,%d,%.2f,", left_period, left_arrival_rate, right_period, right_arrival_rate);
-	fprintf(f, "%d,", result->left_number_of_cars);
-	fprintf(f, "%.2f,", result->left_average_waiting_time);
-	fprintf(f, "%d,", result->left_maximum_waiting_time);
-	fprintf(f, "%d,", result->left_time_to_clear_queue);
-	fprintf(f, "%d,", result->right_number_of_cars);
-	fprintf(f, "%.2f,", result->right_average_waiting_time);
-	fprintf(f, "%d,", result->right_maximum_waiting_time);
-	fprintf(f, "%d,", result->right_time_to_clear_queue);
-	fprintf(f, "\n");
-
-	/* Close the file. */
-	fclose(f);
+/* Output parameter values and statistics for a point. */
+void output_point_statistics(POINT *point) {
+	/* Show information about parameter values. */
+	printf("Parameter values:\n");
+	printf("\tFrom left:\n");
+	printf("\t\tTraffic light period: %d\n", point->left_period);
+	printf("\t\tTraffic arrival rate: %.2f\n", point->left_arrival_rate);
+	printf("\tFrom right:\n");
+	printf("\t\tTraffic light period: %d\n", point->right_period);
+	printf("\t\tTraffic arrival rate: %.2f\n", point->right_arrival_rate);
+
+	/* Show results. */
+	output_result_statistics(&point->result);
 }
 
-/* Run a single simulation. */
-RESULT *runOneSimulation(unsigned int left_period, float left_arrival_rate, unsigned int right_period, float right_arrival_rate) {
-	/* Check if parameters are valid. */
-	if ((left_period < 0) || (right_period < 0)) {
-		/* Periods less than 0. */
-		fprintf(stderr, "Fatal! Invalid argument supplied (period was negative).\n");
-		exit(EINVAL);
-	}
-	if ((left_arrival_rate < 0 || left_arrival_rate > 1) || (right_arrival_rate < 0 || right_arrival_rate > 1)) {
-		/* Arrival rates not between 0 and 1. */
-		fprintf(stderr, "Fatal! Invalid argument supplied (arrival rate not between 0 and 1).\n");
-		exit(EINVAL);
+/* Run the simulation from the start while cars are arriving. Cars arrive up
+ * to and including the tick after the cap, which is also the first tick the
+ * drain phase checks. Return the light counter to carry on with.
+ * Single-lane version, drives at most one car through per green tick. */
+unsigned int run_single_lane_arrival_phase(TRAFFIC_LIGHT *left, TRAFFIC_LIGHT *right, unsigned int light_counter, unsigned int cap) {
+	unsigned int count;
+
+	for (count = 0; count <= cap + 1; count++) {
+		/* Check if lights need to be changed. */
+		if (light_counter == 0) {
+			/* Lights need to be changed. */
+			change_traffic_lights(left, right, &light_counter);
+		}
+		else {
+			/* No need to change lights. Add cars to traffic lights. */
+			add_car_to_traffic_light(count, left);
+			add_car_to_traffic_light(count, right);
+
+			/* Drive cars through protected area depending on lights. */
+			if (left->is_green) {
+				drive_car_through_traffic_light(count, left);
+			}
+			else if (right->is_green) {
+				drive_car_through_traffic_light(count, right);
+			}
+		}
+
+		/* Check state and update counter. */
+		check_traffic_lights(left, right);
+		light_counter--;
 	}
 
-	/* Create environment variables used in simulation. */
-	BOOL done = false;
-	BOOL new_arrivals = true;
-	unsigned int count = 0;
-	unsigned int light_counter;
+	return light_counter;
+}
 
-	/* Setup traffic lights. */
-	TRAFFIC_LIGHT *left_traffic_light = new_traffic_light(left_period, left_arrival_rate);
-	TRAFFIC_LIGHT *right_traffic_light = new_traffic_light(right_period, right_arrival_rate);
+/* Run the simulation from the start while cars are arriving. Cars arrive up
+ * to and including the tick after the cap, which is also the first tick the
+ * drain phase checks. Return the light counter to carry on with.
+ * Multi-lane version, drives cars through in bulk per green tick. */
+unsigned int run_multi_lane_arrival_phase(TRAFFIC_LIGHT *left, TRAFFIC_LIGHT *right, unsigned int light_counter, unsigned int cap) {
+	unsigned int count;
 
-	/* Set left traffic light to green. */
-	left_traffic_light->is_green = true;
-	light_counter = left_traffic_light->period;
-	
-	/* Run simulation. */
-	while (!(done)) {
+	for (count = 0; count <= cap + 1; count++) {
 		/* Check if lights need to be changed. */
 		if (light_counter == 0) {
 			/* Lights need to be changed. */
+			change_traffic_lights(left, right, &light_counter);
+		}
+		else {
+			/* No need to change lights. Add cars to traffic lights. */
+			add_car_to_traffic_light(count, left);
+			add_car_to_traffic_light(count, right);
 
-			/* Check which light is currently green. */
-			if (left_traffic_light->is_green) {
-				/* Left light green, reverse lights. */
-				left_traffic_light->is_green = false;
-				right_traffic_light->is_green = true;
-
-				/* Update counter for switching lights to right light period. */
-				light_counter = right_traffic_light->period + 1;
+			/* Drive cars through protected area depending on lights. */
+			if (left->is_green) {
+				drive_cars_through_traffic_light(count, left);
 			}
-			else if (right_traffic_light->is_green) {
-				/* Right light green, reverse lights. */
-				right_traffic_light->is_green = false;
-				left_traffic_light->is_green = true;
-
-				/* Update counter for switching lights to left light period. */
-				light_counter = left_traffic_light->period + 1;
+			else if (right->is_green) {
+				drive_cars_through_traffic_light(count, right);
 			}
 		}
-		else {
-			/* No need to change lights. Run simulation. */
 
-			/* Add cars to traffic lights. */
-			if (new_arrivals) {
-				/* Add cars to left traffic light. */
-				add_car_to_traffic_light(count, left_traffic_light);
+		/* Check state and update counter. */
+		check_traffic_lights(left, right);
+		light_counter--;
+	}
 
-				/* Add cars to right traffic light. */
-				add_car_to_traffic_light(count, right_traffic_light);
-			}
+	return light_counter;
+}
 
-			/* Drive cars through protected area depending on lights. */
-			if (left_traffic_light->is_green) {
-				/* Left traffic light is green, drive cars through. */
-				drive_car_through_traffic_light(count, left_traffic_light);
+/* Run the simulation after the cap, with no new arrivals, until both queues
+ * have been cleared.
+ * Single-lane version, drives at most one car through per green tick. */
+void run_single_lane_drain_phase(TRAFFIC_LIGHT *left, TRAFFIC_LIGHT *right, unsigned int light_counter, unsigned int cap) {
+	unsigned int count = cap + 1;
+
+	while (true) {
+		/* Update times to clear left and right traffic lights. */
+		update_time_to_clear_traffic_light(count - cap, left);
+		update_time_to_clear_traffic_light(count - cap, right);
+
+		/* Check if simulation is complete. */
+		if (is_array_queue_empty(left->queue) && is_array_queue_empty(right->queue)) {
+			/* Both queues empty - stop the simulation. */
+			return;
+		}
+
+		/* Move on to the next tick. */
+		count++;
+
+		/* Check if lights need to be changed. */
+		if (light_counter == 0) {
+			/* Lights need to be changed. */
+			change_traffic_lights(left, right, &light_counter);
+		}
+		else {
+			/* No need to change lights. Drive cars through depending on lights. */
+			if (left->is_green) {
+				drive_car_through_traffic_light(count, left);
 			}
-			else if (right_traffic_light->is_green) {
-				/* Right traffic light is green, drive cars through. */
-				drive_car_through_traffic_light(count, right_traffic_light);
+			else if (right->is_green) {
+				drive_car_through_traffic_light(count, right);
 			}
 		}
 
-		/* Check how many iterations have passed. */
-		if (count > SIMULATION_CAP) {
-			/* Prevent more cars from arriving. */
-			new_arrivals = false;
+		/* Check state and update counter. */
+		check_traffic_lights(left, right);
+		light_counter--;
+	}
+}
+
+/* Run the simulation after the cap, with no new arrivals, until both queues
+ * have been cleared.
+ * Multi-lane version, drives cars through in bulk per green tick. */
+void run_multi_lane_drain_phase(TRAFFIC_LIGHT *left, TRAFFIC_LIGHT *right, unsigned int light_counter, unsigned int cap) {
+	unsigned int count = cap + 1;
 
-			/* Update times to clear left and right traffic lights. */
-			update_time_to_clear_traffic_light(count, left_traffic_light);
-			update_time_to_clear_traffic_light(count, right_traffic_light);
-		}
+	while (true) {
+		/* Update times to clear left and right traffic lights. */
+		update_time_to_clear_traffic_light(count - cap, left);
+		update_time_to_clear_traffic_light(count - cap, right);
 
 		/* Check if simulation is complete. */
-		if (!(new_arrivals) && is_empty(left_traffic_light->queue) && is_empty(right_traffic_light->queue)) {
-			/* No new arrivals, both queues empty - stop the simulation. */
-			done = true;
+		if (is_array_queue_empty(left->queue) && is_array_queue_empty(right->queue)) {
+			/* Both queues empty - stop the simulation. */
+			return;
 		}
 
-		/* Check if simulation has somehow entered an erroneous state. */
-		if (left_traffic_light->is_green == right_traffic_light->is_green) {
-			/* Somehow (?) both traffic lights are the same. */ 
-			fprintf(stderr, "Fatal! Simulation has entered erroneous state (traffic lights in same state).\n");
-			exit(EXIT_FAILURE);
+		/* Move on to the next tick. */
+		count++;
+
+		/* Check if lights need to be changed. */
+		if (light_counter == 0) {
+			/* Lights need to be changed. */
+			change_traffic_lights(left, right, &light_counter);
+		}
+		else {
+			/* No need to change lights. Drive cars through depending on lights. */
+			if (left->is_green) {
+				drive_cars_through_traffic_light(count, left);
+			}
+			else if (right->is_green) {
+				drive_cars_through_traffic_light(count, right);
+			}
 		}
 
-		/* Update counters. */
-		count++;
+		/* Check state and update counter. */
+		check_traffic_lights(left, right);
 		light_counter--;
 	}
+}
+
+/* Run a single simulation. */
+RESULT *runOneSimulation(unsigned int left_period, float left_arrival_rate, unsigned int right_period, float right_arrival_rate) {
+	/* Check if parameters are valid. */
+	if ((left_period < 0) || (right_period < 0)) {
+		/* Periods less than 0. */
+		fprintf(stderr, "Fatal! Invalid argument supplied (period was negative).\n");
+		exit(EINVAL);
+	}
+	if ((left_arrival_rate < 0 || left_arrival_rate > 1) || (right_arrival_rate < 0 || right_arrival_rate > 1)) {
+		/* Arrival rates not between 0 and 1. */
+		fprintf(stderr, "Fatal! Invalid argument supplied (arrival rate not between 0 and 1).\n");
+		exit(EINVAL);
+	}
+
+	/* Setup traffic lights. */
+	TRAFFIC_LIGHT *left_traffic_light = new_traffic_light(left_period, left_arrival_rate,
+			LEFT_NUMBER_OF_LANES, LEFT_DISCHARGE_RATE);
+	TRAFFIC_LIGHT *right_traffic_light = new_traffic_light(right_period, right_arrival_rate,
+			RIGHT_NUMBER_OF_LANES, RIGHT_DISCHARGE_RATE);
+
+	/* Set left traffic light to green. */
+	left_traffic_light->is_green = true;
+	unsigned int light_counter = left_traffic_light->period;
+
+	/* Run simulation, first with arrivals up to the cap and then without.
+	 * Single lanes don't need bulk departures, so use the simpler loops. */
+	if (left_traffic_light->number_of_lanes == 1 && left_traffic_light->discharge_rate == 1
+			&& right_traffic_light->number_of_lanes == 1 && right_traffic_light->discharge_rate == 1) {
+		light_counter = run_single_lane_arrival_phase(left_traffic_light, right_traffic_light, light_counter, SIMULATION_CAP);
+		run_single_lane_drain_phase(left_traffic_light, right_traffic_light, light_counter, SIMULATION_CAP);
+	}
+	else {
+		light_counter = run_multi_lane_arrival_phase(left_traffic_light, right_traffic_light, light_counter, SIMULATION_CAP);
+		run_multi_lane_drain_phase(left_traffic_light, right_traffic_light, light_counter, SIMULATION_CAP);
+	}
 
 	/* Save result. */
 	RESULT *result = save_result(left_traffic_light, right_traffic_light);
@@ -430,8 +749,8 @@ RESULT *runOneSimulation(unsigned int left_period, float left_arrival_rate, unsi
 	/* Free allocated memory. */
 
 	/* Free queues. */
-	free(left_traffic_light->queue);
-	free(right_traffic_light->queue);
+	free_array_queue(left_traffic_light->queue);
+	free_array_queue(right_traffic_light->queue);
 
 	/* Free actual traffic lights. */
 	free(left_traffic_light);
@@ -447,7 +766,7 @@ RESULT *run_multiple_simulations(unsigned int left_period, float left_arrival_ra
 	RESULT *average = new_result();
 
 	/* Repeat simulation multiple times, update running average for results. */
-	int i;
+	unsigned int i;
 	for (i = 0; i < NUMBER_OF_SIMULATIONS; i++) {
 		/* Perform one simulation. */
 		RESULT *r = runOneSimulation(left_period, left_arrival_rate, right_period, right_arrival_rate);
@@ -471,3 +790,36 @@ RESULT *run_multiple_simulations(unsigned int left_period, float left_arrival_ra
 	/* Return the average result. */
 	return average;
 }
+
+/* Get the number of points in a sweep. */
+unsigned int sweep_size(SWEEP *sweep) {
+	unsigned int number_of_periods = sweep->maximum_period - sweep->minimum_period + 1;
+
+	/* Every combination of left and right periods and arrival rates. */
+	return number_of_periods * number_of_periods * sweep->number_of_arrival_rates * sweep->number_of_arrival_rates;
+}
+
+/* Run the simulations for one point of a sweep and store them in a point. */
+void run_sweep_point(SWEEP *sweep, unsigned int index, POINT *point) {
+	unsigned int number_of_periods = sweep->maximum_period - sweep->minimum_period + 1;
+	unsigned int number_of_arrival_rates = sweep->number_of_arrival_rates;
+
+	/* Get parameters from index, in the same order as extras/generateCSV. */
+	point->right_arrival_rate = sweep->arrival_rate_step * (index % number_of_arrival_rates + 1);
+	index /= number_of_arrival_rates;
+	point->left_arrival_rate = sweep->arrival_rate_step * (index % number_of_arrival_rates + 1);
+	index /= number_of_arrival_rates;
+	point->right_period = sweep->minimum_period + index % number_of_periods;
+	index /= number_of_periods;
+	point->left_period = sweep->minimum_period + index;
+
+	/* Perform simulations. */
+	RESULT *average = run_multiple_simulations(point->left_period, point->left_arrival_rate,
+			point->right_period, point->right_arrival_rate);
+
+	/* Save result to point. */
+	point->result = *average;
+
+	/* Free allocated memory. */
+	free(average);
+}
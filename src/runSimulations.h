@@ -1,8 +1,12 @@
 /* Compiler directives. */
 
 #include <errno.h>
+#include <float.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <time.h>
 #include <gsl/gsl_rng.h>
 
 #include <queue.h>
@@ -12,34 +16,58 @@
 #include <util.h>
 #endif
 
-/* Number of simulations to run. */
-#define NUMBER_OF_SIMULATIONS 100
+/* Default number of simulations to run. */
+#define DEFAULT_NUMBER_OF_SIMULATIONS 100
 
-/* When to cap the simulation. */
-#define SIMULATION_CAP 500
+/* Default point at which to cap the simulation. */
+#define DEFAULT_SIMULATION_CAP 500
 
-/* Output CSV file. */
-#define OUTPUT_CSV_FILE "result.csv"
+/* Largest allowed cap, leaving room for ticks to keep counting while draining. */
+#define MAXIMUM_SIMULATION_CAP (UINT_MAX / 2)
+
+/* Default output CSV file. */
+#define DEFAULT_OUTPUT_CSV_FILE "result.csv"
+
+/* Default number of lanes on each approach. */
+#define DEFAULT_NUMBER_OF_LANES 1
+
+/* Default number of cars each lane discharges per green tick. */
+#define DEFAULT_DISCHARGE_RATE 1.0
 
 /* Global variables. */
 
 /* Random number generator. */
-gsl_rng *RNG;
+extern gsl_rng *RNG;
 
-/* Structure definitions. */
+/* Number of simulations to run. */
+extern unsigned int NUMBER_OF_SIMULATIONS;
 
-/* Car structure, used for storing information about cars. */
-struct car {
-	unsigned int arrival_time;
-};
-typedef struct car CAR;
+/* When to cap the simulation (no new arrivals after this tick). */
+extern unsigned int SIMULATION_CAP;
+
+/* Output CSV file. */
+extern char *OUTPUT_CSV_FILE;
+
+/* Number of lanes on the left and right approaches. */
+extern unsigned int LEFT_NUMBER_OF_LANES;
+extern unsigned int RIGHT_NUMBER_OF_LANES;
+
+/* Number of cars each lane discharges per green tick (saturation flow). */
+extern float LEFT_DISCHARGE_RATE;
+extern float RIGHT_DISCHARGE_RATE;
+
+/* Structure definitions. */
 
 /* Traffic light structure, used for storing information about lights. */
 struct traffic_light {
 	unsigned int period;
 	float arrival_rate;
+
+	unsigned int number_of_lanes;
+	float discharge_rate;
+	float discharge_capacity;
 	
-	QUEUE *queue;
+	ARRAY_QUEUE *queue;
 	BOOL is_green;
 
 	unsigned int number_of_cars;
@@ -64,26 +92,59 @@ struct result {
 };
 typedef struct result RESULT;
 
+/* Point structure, used for storing the parameters and result of a run. */
+struct point {
+	unsigned int left_period;
+	float left_arrival_rate;
+	unsigned int right_period;
+	float right_arrival_rate;
+
+	RESULT result;
+};
+typedef struct point POINT;
+
+/* Sweep structure, used for storing a grid of parameters to run. */
+struct sweep {
+	unsigned int minimum_period;
+	unsigned int maximum_period;
+
+	double arrival_rate_step;
+	unsigned int number_of_arrival_rates;
+};
+typedef struct sweep SWEEP;
+
 /* Function prototypes. */
 
 void setup_rng();
-double random();
+double random_uniform();
 float running_average(float average, unsigned int n, unsigned int x);
+float running_average_bulk(float average, unsigned int n, double total, unsigned int k);
 
 unsigned int get_period(char *string);
+unsigned int get_count(char *string);
 float get_arrival_rate(char *string);
+float get_discharge_rate(char *string);
 
-CAR *new_car(unsigned int arrival_time);
-TRAFFIC_LIGHT *new_traffic_light(unsigned int period, float arrival_rate);
+TRAFFIC_LIGHT *new_traffic_light(unsigned int period, float arrival_rate, unsigned int number_of_lanes, float discharge_rate);
 RESULT *new_result();
+SWEEP *new_sweep();
 RESULT *save_result(TRAFFIC_LIGHT *left, TRAFFIC_LIGHT *right);
 
 void add_car_to_traffic_light(unsigned int count, TRAFFIC_LIGHT *traffic_light);
 void drive_car_through_traffic_light(unsigned int count, TRAFFIC_LIGHT *traffic_light);
-void update_time_to_clear_traffic_light(unsigned int count, TRAFFIC_LIGHT *traffic_light);
+void drive_cars_through_traffic_light(unsigned int count, TRAFFIC_LIGHT *traffic_light);
+void update_time_to_clear_traffic_light(unsigned int time, TRAFFIC_LIGHT *traffic_light);
+void change_traffic_lights(TRAFFIC_LIGHT *left, TRAFFIC_LIGHT *right, unsigned int *light_counter);
+void check_traffic_lights(TRAFFIC_LIGHT *left, TRAFFIC_LIGHT *right);
 void output_traffic_light_statistics(TRAFFIC_LIGHT *traffic_light);
 void output_result_statistics(RESULT *result);
-void output_result_statistics_csv(RESULT *result, unsigned int left_period, float left_arrival_rate, unsigned int right_period, float right_arrival_rate);
+void output_point_statistics(POINT *point);
 
+unsigned int run_single_lane_arrival_phase(TRAFFIC_LIGHT *left, TRAFFIC_LIGHT *right, unsigned int light_counter, unsigned int cap);
+unsigned int run_multi_lane_arrival_phase(TRAFFIC_LIGHT *left, TRAFFIC_LIGHT *right, unsigned int light_counter, unsigned int cap);
+void run_single_lane_drain_phase(TRAFFIC_LIGHT *left, TRAFFIC_LIGHT *right, unsigned int light_counter, unsigned int cap);
+void run_multi_lane_drain_phase(TRAFFIC_LIGHT *left, TRAFFIC_LIGHT *right, unsigned int light_counter, unsigned int cap);
 RESULT *runOneSimulation(unsigned int left_period, float left_arrival_rate, unsigned int right_period, float right_arrival_rate);
 RESULT *run_multiple_simulations(unsigned int left_period, float left_arrival_rate, unsigned int right_period, float right_arrival_rate);
+unsigned int sweep_size(SWEEP *sweep);
+void run_sweep_point(SWEEP *sweep, unsigned int index, POINT *point);
@@ -5,7 +5,7 @@
 /* Function definitions. */
 
 /* Safely allocate some memory. */
-void *safe_malloc(unsigned int size) {
+void *safe_malloc(size_t size) {
 	/* Attempt to allocate some memory. */
 	void *ptr = malloc(size);
 
@@ -20,3 +20,20 @@ void *safe_malloc(unsigned int size) {
 		return ptr;
 	}
 }
+
+/* Safely resize some allocated memory. */
+void *safe_realloc(void *ptr, size_t size) {
+	/* Attempt to resize memory. */
+	void *new_ptr = realloc(ptr, size);
+
+	/* Check if resize was successful. */
+	if (new_ptr == NULL) {
+		/* Resize failed, report error to user. */
+		fprintf(stderr, "Fatal! Could not allocate memory.\n");
+		exit(ENOMEM);
+	}
+	else {
+		/* Resize successful, return pointer. */
+		return new_ptr;
+	}
+}
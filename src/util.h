@@ -11,4 +11,5 @@ typedef enum {false, true} BOOL;
 
 /* Function prototypes. */
 
-void *safe_malloc(unsigned int size);
+void *safe_malloc(size_t size);
+void *safe_realloc(void *ptr, size_t size);